@@ -9,7 +9,7 @@ cmake ..
 make
 
 echo -e "\nTests:"
-./test_runner ./statdump_tool
+./test_runner --no-perf
 
 echo -e "\nTest Table form:"
 ./statdump_tool t_ele_a.bin t_ele_b.bin t_ele_out.bin
\ No newline at end of file
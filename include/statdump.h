@@ -19,7 +19,8 @@ typedef enum {
     SD_ERR_IO,
     SD_ERR_FMT,
     SD_ERR_OOM,
-    SD_ERR_INVAL
+    SD_ERR_INVAL,
+    SD_ERR_NOTFOUND
 } SdStatus;
 
 // I/O 
@@ -33,8 +34,50 @@ SdStatus JoinDump(const StatData *a, size_t na,
 
 void SortDump(StatData *arr, size_t n);
 
+// Point lookup over an id-sorted dump (e.g. stored JoinDump output before SortDump).
+// BuildDumpIndex writes a sidecar index; lookups mmap the dump and touch only
+// the index plus one block of records per id.
+typedef struct SdDumpIndex SdDumpIndex;
+
+SdStatus BuildDumpIndex(const char *dump_path, const char *idx_path);
+SdStatus OpenDumpIndex(const char *dump_path, const char *idx_path, SdDumpIndex **out_ix);
+void CloseDumpIndex(SdDumpIndex *ix);
+
+// SD_ERR_NOTFOUND if id is absent
+SdStatus LookupDumpId(const SdDumpIndex *ix, long id, StatData *out);
+// found[i] is set to 1 and out[i] filled for every ids[i] present, 0 otherwise
+SdStatus LookupDump(const SdDumpIndex *ix, const long *ids, size_t n,
+                    StatData *out, unsigned char *found);
+
+// Single-pass approximate summary with bounded memory. Sketches are mergeable
+// and serializable, so per-shard summaries can be combined later.
+// Distinct ids (HyperLogLog, ~1.6% error) estimate the JoinDump row count;
+// cost quantiles (~1% relative error) and the exact per-mode / per-primary
+// totals are taken over input records, not over joined rows.
+typedef struct SdSummary SdSummary;
+
+typedef struct {
+    uint64_t records;
+    int64_t count;
+    double cost;
+} SdSummaryTotals;
+
+SdStatus SummaryCreate(SdSummary **out_s);
+void SummaryFree(SdSummary *s);
+SdStatus SummaryAdd(SdSummary *s, const StatData *arr, size_t n);
+SdStatus SummaryAddDump(SdSummary *s, const char *path); // streams, never loads the whole dump
+SdStatus SummaryMerge(SdSummary *dst, const SdSummary *src); // SD_ERR_INVAL if dst == src
+SdStatus SummaryStore(const char *path, const SdSummary *s);
+SdStatus SummaryLoad(const char *path, SdSummary **out_s);
+
+double SummaryDistinctIds(const SdSummary *s);
+float SummaryCostQuantile(const SdSummary *s, double q); // q in [0, 1]; NaN if empty or q is NaN
+void SummaryTotals(const SdSummary *s, SdSummaryTotals *all,
+                   SdSummaryTotals by_mode[8], SdSummaryTotals by_primary[2]);
+
 // Output formatting
 void PrintTop10Table(const StatData *arr, size_t n);
+void PrintSummary(const SdSummary *s);
 
 // Helpers
 const char* SdStatusStr(SdStatus s);
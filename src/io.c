@@ -1,26 +1,10 @@
 #include "statdump.h"
+#include "sd_format.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
-#define SD_MAGIC 0x504D4453u // 'SDMP' | file identifier
-#define SD_VERSION 1u // file format version
-
-typedef struct {
-    uint32_t magic;
-    uint32_t version;
-    uint32_t nrecords;
-} __attribute__((packed)) SdHeader;
-
-typedef struct {
-    int64_t  id;
-    int32_t  count;
-    float    cost;
-    uint8_t  primary;
-    uint8_t  mode;
-} __attribute__((packed)) SdRecord;
-
 static SdStatus write_all(FILE *f, const void *p, size_t sz) {
     return (fwrite(p, 1, sz, f) == sz) ? SD_OK : SD_ERR_IO;
 }
@@ -79,11 +63,7 @@ SdStatus LoadDump(const char *path, StatData **out_arr, size_t *out_n) {
         st = read_all(f, &r, sizeof(r));
         if (st != SD_OK) { free(arr); fclose(f); return st; }
 
-        arr[i].id = (long)r.id;
-        arr[i].count = (int)r.count;
-        arr[i].cost = r.cost;
-        arr[i].primary = (unsigned)(r.primary ? 1 : 0);
-        arr[i].mode = (unsigned)(r.mode & 0x7u);
+        sd_record_decode(&r, &arr[i]);
     }
 
     fclose(f);
@@ -99,6 +79,7 @@ const char* SdStatusStr(SdStatus s) {
         case SD_ERR_FMT: return "Format error";
         case SD_ERR_OOM: return "Out of memory";
         case SD_ERR_INVAL: return "Invalid argument";
+        case SD_ERR_NOTFOUND: return "Not found";
         default: return "Unknown";
     }
 }
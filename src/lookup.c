@@ -0,0 +1,297 @@
+#define _DEFAULT_SOURCE
+#include "statdump.h"
+#include "sd_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SD_LOOKUP_BATCH 16 // queries walked through the index in lockstep
+#define SD_PREFETCH_PROBES 7 // midpoints of the first three binary-search levels
+#define SD_IDX_SPOT_CHECKS 16 // sampled keys compared with the dump on open
+
+struct SdDumpIndex {
+    void *map;              // whole dump file, read-only
+    size_t map_len;
+    const unsigned char *recs; // first record
+    size_t nrecords;
+    size_t stride;
+    size_t nsamples;
+    SdIdxEntry *tree;       // 1-based Eytzinger layout, tree[0] unused
+};
+
+// -------------------- dump mapping --------------------
+
+static SdStatus map_dump(const char *path, void **out_map, size_t *out_len, size_t *out_n) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return SD_ERR_IO;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0) { close(fd); return SD_ERR_IO; }
+
+    size_t len = (size_t)sb.st_size;
+    if (len < sizeof(SdHeader)) { close(fd); return SD_ERR_FMT; }
+
+    void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return SD_ERR_IO;
+
+    SdHeader h;
+    memcpy(&h, map, sizeof(h));
+    if (h.magic != SD_MAGIC || h.version != SD_VERSION ||
+        len != sizeof(SdHeader) + (size_t)h.nrecords * sizeof(SdRecord)) {
+        munmap(map, len);
+        return SD_ERR_FMT;
+    }
+
+    *out_map = map;
+    *out_len = len;
+    *out_n = (size_t)h.nrecords;
+    return SD_OK;
+}
+
+static inline int64_t rec_id(const unsigned char *recs, size_t i) {
+    int64_t id;
+    memcpy(&id, recs + i * sizeof(SdRecord), sizeof(id));
+    return id;
+}
+
+static void rec_to_stat(const unsigned char *recs, size_t i, StatData *out) {
+    SdRecord r;
+    memcpy(&r, recs + i * sizeof(SdRecord), sizeof(r));
+    sd_record_decode(&r, out);
+}
+
+// -------------------- index build --------------------
+
+// In-order walk of the implicit tree assigns sorted samples to Eytzinger slots
+static size_t eytzinger_fill(SdIdxEntry *tree, const SdIdxEntry *sorted, size_t m,
+                             size_t i, size_t k) {
+    if (k <= m) {
+        i = eytzinger_fill(tree, sorted, m, i, 2 * k);
+        tree[k] = sorted[i++];
+        i = eytzinger_fill(tree, sorted, m, i, 2 * k + 1);
+    }
+    return i;
+}
+
+SdStatus BuildDumpIndex(const char *dump_path, const char *idx_path) {
+    if (!dump_path || !idx_path) return SD_ERR_INVAL;
+
+    void *map = NULL; size_t len = 0, n = 0;
+    SdStatus st = map_dump(dump_path, &map, &len, &n);
+    if (st != SD_OK) return st;
+
+    const unsigned char *recs = (const unsigned char*)map + sizeof(SdHeader);
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    // Lookups binary-search inside blocks, so ids must be strictly ascending
+    for (size_t i = 1; i < n; i++) {
+        if (rec_id(recs, i - 1) >= rec_id(recs, i)) { munmap(map, len); return SD_ERR_FMT; }
+    }
+
+    size_t m = (n + SD_IDX_STRIDE - 1) / SD_IDX_STRIDE;
+    SdIdxEntry *sorted = (m == 0) ? NULL : (SdIdxEntry*)malloc(m * sizeof(SdIdxEntry));
+    SdIdxEntry *tree = (SdIdxEntry*)calloc(m + 1, sizeof(SdIdxEntry));
+    if ((m != 0 && !sorted) || !tree) { free(sorted); free(tree); munmap(map, len); return SD_ERR_OOM; }
+
+    for (size_t s = 0; s < m; s++) {
+        sorted[s].rec = (uint64_t)(s * SD_IDX_STRIDE);
+        sorted[s].key = rec_id(recs, s * SD_IDX_STRIDE);
+    }
+    eytzinger_fill(tree, sorted, m, 0, 1);
+    free(sorted);
+
+    int64_t first = n ? rec_id(recs, 0) : 0;
+    int64_t last = n ? rec_id(recs, n - 1) : 0;
+    munmap(map, len);
+
+    FILE *f = fopen(idx_path, "wb");
+    if (!f) { free(tree); return SD_ERR_IO; }
+
+    SdIdxHeader h = { SD_IDX_MAGIC, SD_IDX_VERSION, (uint32_t)n, SD_IDX_STRIDE, (uint32_t)m,
+                      first, last };
+    st = (fwrite(&h, 1, sizeof(h), f) == sizeof(h)) ? SD_OK : SD_ERR_IO;
+    if (st == SD_OK && m != 0 && fwrite(tree + 1, sizeof(SdIdxEntry), m, f) != m) st = SD_ERR_IO;
+    free(tree);
+
+    if (fclose(f) != 0 && st == SD_OK) st = SD_ERR_IO;
+    return st;
+}
+
+// -------------------- open / close --------------------
+
+// In-order walk must visit blocks 0, stride, 2*stride, ... with ascending keys
+static int eytzinger_check(const SdIdxEntry *tree, size_t m, size_t stride,
+                           size_t k, size_t *next, int64_t *prev) {
+    if (k > m) return 1;
+    if (!eytzinger_check(tree, m, stride, 2 * k, next, prev)) return 0;
+    if (tree[k].rec != (uint64_t)(*next * stride)) return 0;
+    if (*next && tree[k].key <= *prev) return 0;
+    *prev = tree[k].key;
+    (*next)++;
+    return eytzinger_check(tree, m, stride, 2 * k + 1, next, prev);
+}
+
+// The sidecar must describe this very dump, not just one of the same size
+static int index_matches_dump(const SdDumpIndex *ix, const SdIdxHeader *h) {
+    size_t n = ix->nrecords, m = ix->nsamples;
+    if (n && (rec_id(ix->recs, 0) != h->first_id || rec_id(ix->recs, n - 1) != h->last_id)) return 0;
+
+    size_t next = 0;
+    int64_t prev = 0;
+    if (!eytzinger_check(ix->tree, m, ix->stride, 1, &next, &prev) || next != m) return 0;
+
+    size_t step = (m > SD_IDX_SPOT_CHECKS) ? m / SD_IDX_SPOT_CHECKS : 1;
+    for (size_t k = 1; k <= m; k += step) {
+        if (rec_id(ix->recs, (size_t)ix->tree[k].rec) != ix->tree[k].key) return 0;
+    }
+    return 1;
+}
+
+SdStatus OpenDumpIndex(const char *dump_path, const char *idx_path, SdDumpIndex **out_ix) {
+    if (!dump_path || !idx_path || !out_ix) return SD_ERR_INVAL;
+    *out_ix = NULL;
+
+    SdDumpIndex *ix = (SdDumpIndex*)calloc(1, sizeof(SdDumpIndex));
+    if (!ix) return SD_ERR_OOM;
+
+    SdStatus st = map_dump(dump_path, &ix->map, &ix->map_len, &ix->nrecords);
+    if (st != SD_OK) { free(ix); return st; }
+    ix->recs = (const unsigned char*)ix->map + sizeof(SdHeader);
+    madvise(ix->map, ix->map_len, MADV_RANDOM);
+
+    FILE *f = fopen(idx_path, "rb");
+    if (!f) { CloseDumpIndex(ix); return SD_ERR_IO; }
+
+    SdIdxHeader h;
+    if (fread(&h, 1, sizeof(h), f) != sizeof(h)) { fclose(f); CloseDumpIndex(ix); return SD_ERR_IO; }
+
+    if (h.magic != SD_IDX_MAGIC || h.version != SD_IDX_VERSION ||
+        h.nrecords != ix->nrecords || h.stride == 0 ||
+        h.nsamples != (h.nrecords + h.stride - 1) / h.stride) {
+        fclose(f);
+        CloseDumpIndex(ix);
+        return SD_ERR_FMT;
+    }
+
+    ix->stride = (size_t)h.stride;
+    ix->nsamples = (size_t)h.nsamples;
+    ix->tree = (SdIdxEntry*)calloc(ix->nsamples + 1, sizeof(SdIdxEntry));
+    if (!ix->tree) { fclose(f); CloseDumpIndex(ix); return SD_ERR_OOM; }
+
+    if (ix->nsamples != 0 &&
+        fread(ix->tree + 1, sizeof(SdIdxEntry), ix->nsamples, f) != ix->nsamples) {
+        fclose(f);
+        CloseDumpIndex(ix);
+        return SD_ERR_IO;
+    }
+    fclose(f);
+
+    if (!index_matches_dump(ix, &h)) { CloseDumpIndex(ix); return SD_ERR_FMT; }
+
+    *out_ix = ix;
+    return SD_OK;
+}
+
+void CloseDumpIndex(SdDumpIndex *ix) {
+    if (!ix) return;
+    if (ix->map) munmap(ix->map, ix->map_len);
+    free(ix->tree);
+    free(ix);
+}
+
+// -------------------- lookup --------------------
+
+// One descent step; children of k live at 2k and 2k+1, so 16k is four levels down
+static inline size_t descend(const SdDumpIndex *ix, size_t k, int64_t id) {
+    __builtin_prefetch(ix->tree + 16 * k);
+    return 2 * k + (size_t)(ix->tree[k].key <= id);
+}
+
+// Final node of a descent -> first record of the block that may hold id,
+// or SIZE_MAX when id is below the first sample.
+static inline size_t block_of(const SdDumpIndex *ix, size_t k) {
+    k >>= __builtin_ffsll(~(long long)k); // first sample with key > id
+    if (k == 0) return (ix->nsamples - 1) * ix->stride;
+    if (ix->tree[k].rec == 0) return SIZE_MAX;
+    return (size_t)ix->tree[k].rec - ix->stride;
+}
+
+static inline void prefetch_probes(const SdDumpIndex *ix, size_t lo) {
+    size_t len = ix->nrecords - lo;
+    if (len > ix->stride) len = ix->stride;
+    for (size_t p = 1; p <= SD_PREFETCH_PROBES; p++) {
+        __builtin_prefetch(ix->recs + (lo + len * p / (SD_PREFETCH_PROBES + 1)) * sizeof(SdRecord));
+    }
+}
+
+static int search_block(const SdDumpIndex *ix, size_t lo, int64_t id, StatData *out) {
+    size_t hi = lo + ix->stride;
+    if (hi > ix->nrecords) hi = ix->nrecords;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int64_t v = rec_id(ix->recs, mid);
+        if (v == id) { rec_to_stat(ix->recs, mid, out); return 1; }
+        if (v < id) lo = mid + 1; else hi = mid;
+    }
+    return 0;
+}
+
+SdStatus LookupDumpId(const SdDumpIndex *ix, long id, StatData *out) {
+    if (!ix || !out) return SD_ERR_INVAL;
+    if (ix->nsamples == 0) return SD_ERR_NOTFOUND;
+
+    size_t k = 1;
+    while (k <= ix->nsamples) k = descend(ix, k, (int64_t)id);
+
+    size_t blk = block_of(ix, k);
+    if (blk == SIZE_MAX) return SD_ERR_NOTFOUND;
+    return search_block(ix, blk, (int64_t)id, out) ? SD_OK : SD_ERR_NOTFOUND;
+}
+
+SdStatus LookupDump(const SdDumpIndex *ix, const long *ids, size_t n,
+                    StatData *out, unsigned char *found) {
+    if (!ix || (n && (!ids || !out || !found))) return SD_ERR_INVAL;
+    if (ix->nsamples == 0) {
+        if (n) memset(found, 0, n);
+        return SD_OK;
+    }
+
+    size_t k[SD_LOOKUP_BATCH];
+    size_t blk[SD_LOOKUP_BATCH];
+
+    for (size_t base = 0; base < n; base += SD_LOOKUP_BATCH) {
+        size_t g = (n - base < SD_LOOKUP_BATCH) ? n - base : SD_LOOKUP_BATCH;
+
+        // Walk the whole group one level at a time so the index misses overlap
+        for (size_t q = 0; q < g; q++) k[q] = 1;
+        for (int active = 1; active; ) {
+            active = 0;
+            for (size_t q = 0; q < g; q++) {
+                if (k[q] <= ix->nsamples) {
+                    k[q] = descend(ix, k[q], (int64_t)ids[base + q]);
+                    active = 1;
+                }
+            }
+        }
+
+        // Before searching any block, pull in the lines the first three
+        // binary-search probes of every block can land on
+        for (size_t q = 0; q < g; q++) {
+            blk[q] = block_of(ix, k[q]);
+            if (blk[q] != SIZE_MAX) prefetch_probes(ix, blk[q]);
+        }
+
+        for (size_t q = 0; q < g; q++) {
+            size_t i = base + q;
+            found[i] = (unsigned char)(blk[q] != SIZE_MAX &&
+                                       search_block(ix, blk[q], (int64_t)ids[i], &out[i]));
+        }
+    }
+    return SD_OK;
+}
@@ -1,10 +1,41 @@
 #include "statdump.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// --summary <out.sum> <in>...: inputs are dumps or earlier summaries
+static int run_summary(int argc, char **argv) {
+    SdSummary *s = NULL;
+    SdStatus st = SummaryCreate(&s);
+    if (st != SD_OK) { fprintf(stderr, "SummaryCreate: %s\n", SdStatusStr(st)); return 1; }
+
+    for (int i = 3; i < argc; i++) {
+        SdSummary *part = NULL;
+        st = SummaryLoad(argv[i], &part);
+        if (st == SD_OK) {
+            st = SummaryMerge(s, part);
+            SummaryFree(part);
+        } else if (st == SD_ERR_FMT) {
+            st = SummaryAddDump(s, argv[i]);
+        }
+        if (st != SD_OK) { fprintf(stderr, "Summary(%s): %s\n", argv[i], SdStatusStr(st)); SummaryFree(s); return 1; }
+    }
+
+    PrintSummary(s);
+
+    st = SummaryStore(argv[2], s);
+    SummaryFree(s);
+    if (st != SD_OK) { fprintf(stderr, "SummaryStore(%s): %s\n", argv[2], SdStatusStr(st)); return 1; }
+
+    return 0;
+}
 
 int main(int argc, char **argv) {
+    if (argc >= 4 && strcmp(argv[1], "--summary") == 0) return run_summary(argc, argv);
+
     if (argc != 4) {
-        fprintf(stderr, "Usage: %s <in_a> <in_b> <out>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <in_a> <in_b> <out>\n"
+                        "       %s --summary <out.sum> <dump_or_sum>...\n", argv[0], argv[0]);
         return 2;
     }
 
@@ -26,3 +26,28 @@ void PrintTop10Table(const StatData *arr, size_t n) {
         putchar('\n');
     }
 }
+
+void PrintSummary(const SdSummary *s) {
+    SdSummaryTotals all, by_mode[8], by_primary[2];
+    SummaryTotals(s, &all, by_mode, by_primary);
+
+    printf("records: %llu  distinct ids (approx): %.0f\n",
+           (unsigned long long)all.records, SummaryDistinctIds(s));
+    printf("cost p50 % .3e  p90 % .3e  p99 % .3e  max % .3e\n",
+           SummaryCostQuantile(s, 0.50), SummaryCostQuantile(s, 0.90),
+           SummaryCostQuantile(s, 0.99), SummaryCostQuantile(s, 1.0));
+
+    printf("%-9s %-12s %-14s %-10s\n", "", "records", "count", "cost");
+    printf("---------------------------------------------------------------\n");
+    for (unsigned m = 0; m < 8; m++) {
+        if (!by_mode[m].records) continue;
+        printf("mode ");
+        print_mode_bin(m);
+        printf("%*s %-12llu %-14lld % .3e\n", (int)(m < 2 ? 3 : m < 4 ? 2 : 1), "",
+               (unsigned long long)by_mode[m].records, (long long)by_mode[m].count, by_mode[m].cost);
+    }
+    for (int p = 1; p >= 0; p--) {
+        printf("primary %s %-12llu %-14lld % .3e\n", p ? "y" : "n",
+               (unsigned long long)by_primary[p].records, (long long)by_primary[p].count, by_primary[p].cost);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "statdump.h"
+#include <stdint.h>
+
+#define SD_MAGIC 0x504D4453u // 'SDMP' | file identifier
+#define SD_VERSION 1u // file format version
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nrecords;
+} __attribute__((packed)) SdHeader;
+
+typedef struct {
+    int64_t  id;
+    int32_t  count;
+    float    cost;
+    uint8_t  primary;
+    uint8_t  mode;
+} __attribute__((packed)) SdRecord;
+
+static inline void sd_record_decode(const SdRecord *r, StatData *out) {
+    out->id = (long)r->id;
+    out->count = (int)r->count;
+    out->cost = r->cost;
+    out->primary = (unsigned)(r->primary ? 1 : 0);
+    out->mode = (unsigned)(r->mode & 0x7u);
+}
+
+// Sidecar point-lookup index over an id-sorted dump (see lookup.c)
+#define SD_IDX_MAGIC 0x58494453u // 'SDIX'
+#define SD_IDX_VERSION 2u
+#define SD_IDX_STRIDE 128u // records per indexed block
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nrecords; // must match the dump header
+    uint32_t stride;
+    uint32_t nsamples;
+    int64_t  first_id; // fingerprint of the indexed dump
+    int64_t  last_id;
+} __attribute__((packed)) SdIdxHeader;
+
+typedef struct {
+    int64_t  key; // id of the first record in the block
+    uint64_t rec; // index of that record in the dump
+} SdIdxEntry;
+
+// Serialized SdSummary (see summary.c)
+#define SD_SUM_MAGIC 0x4D534453u // 'SDSM'
+#define SD_SUM_VERSION 2u
+#define SD_HLL_P 12u // 4096 one-byte registers
+#define SD_QS_BINS 1024u // log buckets per cost sign
+#define SD_QS_ALPHA 0.01 // relative accuracy of cost quantiles
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t hll_p;
+    uint32_t qs_bins;
+    double   qs_alpha;
+} __attribute__((packed)) SdSumHeader;
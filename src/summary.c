@@ -0,0 +1,374 @@
+#include "statdump.h"
+#include "sd_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define SD_HLL_M (1u << SD_HLL_P)
+#define SD_QS_MIN 1e-9 // |cost| below this counts as zero
+#define SD_SUM_CHUNK 4096 // records per read in SummaryAddDump
+
+// Log-bucketed cost store (DDSketch-style): key k holds magnitudes in
+// (gamma^(k-1), gamma^k]. The window covers SD_QS_BINS consecutive keys;
+// when a key falls outside, the lowest buckets are collapsed so memory
+// stays fixed and the upper quantiles keep their accuracy.
+typedef struct {
+    int32_t  offset; // key of bins[0]
+    uint32_t used;
+    uint64_t bins[SD_QS_BINS];
+} QsStore;
+
+struct SdSummary {
+    uint8_t hll[SD_HLL_M];
+    QsStore pos, neg;
+    uint64_t zeros;
+    uint64_t infs[2]; // -inf, +inf: outside every bucket
+    float cost_min, cost_max;
+    SdSummaryTotals all;
+    SdSummaryTotals by_mode[8];
+    SdSummaryTotals by_primary[2];
+};
+
+// -------------------- sketches --------------------
+
+static inline uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+static inline void hll_add(uint8_t *reg, long id) {
+    uint64_t h = mix64((uint64_t)(int64_t)id);
+    uint32_t j = (uint32_t)(h >> (64 - SD_HLL_P));
+    uint64_t w = (h << SD_HLL_P) | (1ull << (SD_HLL_P - 1)); // guard bit bounds the rank
+    uint8_t rank = (uint8_t)(__builtin_clzll(w) + 1);
+    if (rank > reg[j]) reg[j] = rank;
+}
+
+static double qs_gamma(void) {
+    return (1.0 + SD_QS_ALPHA) / (1.0 - SD_QS_ALPHA);
+}
+
+// Key mapping constants, computed once per call rather than per record
+typedef struct {
+    double inv_log_gamma;
+    int32_t key_min; // keys reachable from finite costs: SD_QS_MIN .. FLT_MAX
+    int32_t key_max;
+} QsKeys;
+
+static QsKeys qs_keys(void) {
+    QsKeys k;
+    k.inv_log_gamma = 1.0 / log(qs_gamma());
+    k.key_min = (int32_t)ceil(log(SD_QS_MIN) * k.inv_log_gamma);
+    k.key_max = (int32_t)ceil(log(FLT_MAX) * k.inv_log_gamma);
+    return k;
+}
+
+static inline int32_t qs_key(const QsKeys *keys, double mag) {
+    double k = ceil(log(mag) * keys->inv_log_gamma);
+    if (k < (double)keys->key_min) return keys->key_min;
+    if (k > (double)keys->key_max) return keys->key_max;
+    return (int32_t)k;
+}
+
+static inline double qs_value(int32_t k) {
+    double g = qs_gamma();
+    return 2.0 * pow(g, (double)k) / (g + 1.0);
+}
+
+static void qs_add(QsStore *st, int32_t k, uint64_t c) {
+    if (!st->used) {
+        st->offset = k - (int32_t)(SD_QS_BINS / 2);
+        st->used = 1;
+    }
+
+    int64_t top = (int64_t)st->offset + SD_QS_BINS - 1;
+    if (k > top) {
+        // slide up, folding everything below the new window into its first bin
+        uint64_t d = (uint64_t)((int64_t)k - top);
+        uint64_t low = 0;
+        size_t drop = (d < SD_QS_BINS) ? (size_t)d : SD_QS_BINS;
+        for (size_t i = 0; i < drop; i++) low += st->bins[i];
+        memmove(st->bins, st->bins + drop, (SD_QS_BINS - drop) * sizeof(uint64_t));
+        memset(st->bins + (SD_QS_BINS - drop), 0, drop * sizeof(uint64_t));
+        st->bins[0] += low;
+        st->offset = k - (int32_t)(SD_QS_BINS - 1);
+    } else if (k < st->offset) {
+        // slide down as far as the highest occupied bin allows
+        size_t hi = SD_QS_BINS;
+        while (hi > 0 && st->bins[hi - 1] == 0) hi--;
+        size_t room = SD_QS_BINS - hi;
+        uint64_t want = (uint64_t)((int64_t)st->offset - k);
+        size_t d = (want < room) ? (size_t)want : room;
+        if (d) {
+            memmove(st->bins + d, st->bins, (SD_QS_BINS - d) * sizeof(uint64_t));
+            memset(st->bins, 0, d * sizeof(uint64_t));
+            st->offset -= (int32_t)d;
+        }
+        if (k < st->offset) k = st->offset;
+    }
+    st->bins[k - st->offset] += c;
+}
+
+static uint64_t qs_total(const QsStore *st) {
+    uint64_t t = 0;
+    for (size_t i = 0; i < SD_QS_BINS; i++) t += st->bins[i];
+    return t;
+}
+
+static void totals_add(SdSummaryTotals *t, const SdSummaryTotals *x) {
+    t->records += x->records;
+    t->count += x->count;
+    t->cost += x->cost;
+}
+
+// -------------------- build --------------------
+
+SdStatus SummaryCreate(SdSummary **out_s) {
+    if (!out_s) return SD_ERR_INVAL;
+    SdSummary *s = (SdSummary*)calloc(1, sizeof(SdSummary));
+    if (!s) return SD_ERR_OOM;
+    s->cost_min = INFINITY;
+    s->cost_max = -INFINITY;
+    *out_s = s;
+    return SD_OK;
+}
+
+void SummaryFree(SdSummary *s) {
+    free(s);
+}
+
+SdStatus SummaryAdd(SdSummary *s, const StatData *arr, size_t n) {
+    if (!s || (!arr && n != 0)) return SD_ERR_INVAL;
+
+    const QsKeys keys = qs_keys();
+    for (size_t i = 0; i < n; i++) {
+        const StatData *x = &arr[i];
+        hll_add(s->hll, x->id);
+
+        SdSummaryTotals one = { 1, x->count, x->cost };
+        totals_add(&s->all, &one);
+        totals_add(&s->by_mode[x->mode & 7u], &one);
+        totals_add(&s->by_primary[x->primary ? 1 : 0], &one);
+
+        float c = x->cost;
+        if (isnan(c)) continue;
+        if (c < s->cost_min) s->cost_min = c;
+        if (c > s->cost_max) s->cost_max = c;
+
+        double mag = fabs((double)c);
+        if (isinf(c)) s->infs[c > 0]++;
+        else if (mag < SD_QS_MIN) s->zeros++;
+        else qs_add(c > 0 ? &s->pos : &s->neg, qs_key(&keys, mag), 1);
+    }
+    return SD_OK;
+}
+
+SdStatus SummaryAddDump(SdSummary *s, const char *path) {
+    if (!s || !path) return SD_ERR_INVAL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return SD_ERR_IO;
+
+    SdHeader h;
+    if (fread(&h, 1, sizeof(h), f) != sizeof(h)) { fclose(f); return SD_ERR_IO; }
+    if (h.magic != SD_MAGIC || h.version != SD_VERSION) { fclose(f); return SD_ERR_FMT; }
+
+    SdRecord *raw = (SdRecord*)malloc(SD_SUM_CHUNK * sizeof(SdRecord));
+    StatData *chunk = (StatData*)calloc(SD_SUM_CHUNK, sizeof(StatData));
+    if (!raw || !chunk) { free(raw); free(chunk); fclose(f); return SD_ERR_OOM; }
+
+    SdStatus st = SD_OK;
+    for (size_t left = (size_t)h.nrecords; left > 0 && st == SD_OK; ) {
+        size_t k = (left < SD_SUM_CHUNK) ? left : SD_SUM_CHUNK;
+        if (fread(raw, sizeof(SdRecord), k, f) != k) { st = SD_ERR_IO; break; }
+
+        for (size_t i = 0; i < k; i++) sd_record_decode(&raw[i], &chunk[i]);
+        st = SummaryAdd(s, chunk, k);
+        left -= k;
+    }
+
+    free(raw); free(chunk);
+    fclose(f);
+    return st;
+}
+
+SdStatus SummaryMerge(SdSummary *dst, const SdSummary *src) {
+    if (!dst || !src || dst == src) return SD_ERR_INVAL; // windows slide while being read
+
+    for (size_t j = 0; j < SD_HLL_M; j++) {
+        if (src->hll[j] > dst->hll[j]) dst->hll[j] = src->hll[j];
+    }
+
+    const QsStore *from[2] = { &src->pos, &src->neg };
+    QsStore *to[2] = { &dst->pos, &dst->neg };
+    for (int side = 0; side < 2; side++) {
+        for (size_t i = 0; from[side]->used && i < SD_QS_BINS; i++) {
+            if (from[side]->bins[i]) qs_add(to[side], from[side]->offset + (int32_t)i, from[side]->bins[i]);
+        }
+    }
+    dst->zeros += src->zeros;
+    dst->infs[0] += src->infs[0];
+    dst->infs[1] += src->infs[1];
+    if (src->cost_min < dst->cost_min) dst->cost_min = src->cost_min;
+    if (src->cost_max > dst->cost_max) dst->cost_max = src->cost_max;
+
+    totals_add(&dst->all, &src->all);
+    for (int m = 0; m < 8; m++) totals_add(&dst->by_mode[m], &src->by_mode[m]);
+    for (int p = 0; p < 2; p++) totals_add(&dst->by_primary[p], &src->by_primary[p]);
+    return SD_OK;
+}
+
+// -------------------- serialization --------------------
+
+// Fields are written one by one in declaration order; the header pins the
+// sketch parameters so only compatible summaries are ever merged.
+SdStatus SummaryStore(const char *path, const SdSummary *s) {
+    if (!path || !s) return SD_ERR_INVAL;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return SD_ERR_IO;
+
+    SdSumHeader h = { SD_SUM_MAGIC, SD_SUM_VERSION, SD_HLL_P, SD_QS_BINS, SD_QS_ALPHA };
+    int ok = (fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(s->hll, sizeof(s->hll), 1, f) == 1 &&
+              fwrite(&s->pos, sizeof(s->pos), 1, f) == 1 &&
+              fwrite(&s->neg, sizeof(s->neg), 1, f) == 1 &&
+              fwrite(&s->zeros, sizeof(s->zeros), 1, f) == 1 &&
+              fwrite(s->infs, sizeof(s->infs), 1, f) == 1 &&
+              fwrite(&s->cost_min, sizeof(s->cost_min), 1, f) == 1 &&
+              fwrite(&s->cost_max, sizeof(s->cost_max), 1, f) == 1 &&
+              fwrite(&s->all, sizeof(s->all), 1, f) == 1 &&
+              fwrite(s->by_mode, sizeof(s->by_mode), 1, f) == 1 &&
+              fwrite(s->by_primary, sizeof(s->by_primary), 1, f) == 1);
+    SdStatus st = ok ? SD_OK : SD_ERR_IO;
+
+    if (fclose(f) != 0 && st == SD_OK) st = SD_ERR_IO;
+    return st;
+}
+
+// A store window must sit where qs_add could have put it, so key
+// arithmetic in merge and quantile queries cannot overflow
+static int store_valid(const QsStore *st, const QsKeys *keys) {
+    if (st->used > 1) return 0;
+    if (!st->used) {
+        for (size_t i = 0; i < SD_QS_BINS; i++) if (st->bins[i]) return 0;
+        return 1;
+    }
+    return st->offset >= keys->key_min - (int32_t)SD_QS_BINS && st->offset <= keys->key_max;
+}
+
+static int summary_valid(const SdSummary *s) {
+    for (size_t j = 0; j < SD_HLL_M; j++) {
+        if (s->hll[j] > 64 - SD_HLL_P + 1) return 0;
+    }
+    const QsKeys keys = qs_keys();
+    return store_valid(&s->pos, &keys) && store_valid(&s->neg, &keys);
+}
+
+SdStatus SummaryLoad(const char *path, SdSummary **out_s) {
+    if (!path || !out_s) return SD_ERR_INVAL;
+    *out_s = NULL;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return SD_ERR_IO;
+
+    // too short for a header (e.g. an empty dump) simply is not a summary
+    SdSumHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1) { fclose(f); return SD_ERR_FMT; }
+
+    // sketches merge only with identical parameters
+    if (h.magic != SD_SUM_MAGIC || h.version != SD_SUM_VERSION ||
+        h.hll_p != SD_HLL_P || h.qs_bins != SD_QS_BINS || h.qs_alpha != SD_QS_ALPHA) {
+        fclose(f);
+        return SD_ERR_FMT;
+    }
+
+    SdSummary *s = (SdSummary*)calloc(1, sizeof(SdSummary));
+    if (!s) { fclose(f); return SD_ERR_OOM; }
+
+    int ok = (fread(s->hll, sizeof(s->hll), 1, f) == 1 &&
+              fread(&s->pos, sizeof(s->pos), 1, f) == 1 &&
+              fread(&s->neg, sizeof(s->neg), 1, f) == 1 &&
+              fread(&s->zeros, sizeof(s->zeros), 1, f) == 1 &&
+              fread(s->infs, sizeof(s->infs), 1, f) == 1 &&
+              fread(&s->cost_min, sizeof(s->cost_min), 1, f) == 1 &&
+              fread(&s->cost_max, sizeof(s->cost_max), 1, f) == 1 &&
+              fread(&s->all, sizeof(s->all), 1, f) == 1 &&
+              fread(s->by_mode, sizeof(s->by_mode), 1, f) == 1 &&
+              fread(s->by_primary, sizeof(s->by_primary), 1, f) == 1);
+    int trailing = ok && (fgetc(f) != EOF);
+    fclose(f);
+
+    if (!ok) { free(s); return SD_ERR_IO; }
+    if (trailing || !summary_valid(s)) { free(s); return SD_ERR_FMT; }
+    *out_s = s;
+    return SD_OK;
+}
+
+// -------------------- queries --------------------
+
+double SummaryDistinctIds(const SdSummary *s) {
+    if (!s) return 0.0;
+
+    double m = (double)SD_HLL_M;
+    double inv = 0.0;
+    size_t zeros = 0;
+    for (size_t j = 0; j < SD_HLL_M; j++) {
+        inv += ldexp(1.0, -(int)s->hll[j]);
+        if (s->hll[j] == 0) zeros++;
+    }
+
+    double e = (0.7213 / (1.0 + 1.079 / m)) * m * m / inv;
+    if (e <= 2.5 * m && zeros != 0) e = m * log(m / (double)zeros); // linear counting
+    return e;
+}
+
+float SummaryCostQuantile(const SdSummary *s, double q) {
+    if (!s) return NAN;
+
+    // ascending order: -inf, negative store, zeros, positive store, +inf
+    uint64_t nninf = s->infs[0], nneg = qs_total(&s->neg), npos = qs_total(&s->pos);
+    uint64_t n = nninf + nneg + s->zeros + npos + s->infs[1];
+    if (n == 0 || isnan(q)) return NAN;
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    uint64_t rank = (uint64_t)(q * (double)(n - 1));
+
+    if (rank < nninf) return -INFINITY;
+    rank -= nninf;
+    if (rank >= nneg + s->zeros + npos) return INFINITY;
+
+    double v = 0.0;
+    uint64_t seen = 0;
+    if (rank < nneg) {
+        for (size_t i = SD_QS_BINS; i-- > 0; ) {
+            seen += s->neg.bins[i];
+            if (seen > rank) { v = -qs_value(s->neg.offset + (int32_t)i); break; }
+        }
+    } else if (rank < nneg + s->zeros) {
+        v = 0.0;
+    } else {
+        seen = nneg + s->zeros;
+        for (size_t i = 0; i < SD_QS_BINS; i++) {
+            seen += s->pos.bins[i];
+            if (seen > rank) { v = qs_value(s->pos.offset + (int32_t)i); break; }
+        }
+    }
+
+    if (v < s->cost_min) v = s->cost_min;
+    if (v > s->cost_max) v = s->cost_max;
+    return (float)v;
+}
+
+void SummaryTotals(const SdSummary *s, SdSummaryTotals *all,
+                   SdSummaryTotals by_mode[8], SdSummaryTotals by_primary[2]) {
+    if (!s) return;
+    if (all) *all = s->all;
+    if (by_mode) memcpy(by_mode, s->by_mode, sizeof(s->by_mode));
+    if (by_primary) memcpy(by_primary, s->by_primary, sizeof(s->by_primary));
+}
@@ -1,9 +1,15 @@
+#define _POSIX_C_SOURCE 200809L
 #include "statdump.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
 
 // -------------------- helpers -------------------- 
 
@@ -24,24 +30,65 @@ static int stat_eq(const StatData *a, const StatData *b) {
         a->mode == b->mode);
 }
 
-static int run_tool(const char *tool_path, const char *fa, const char *fb, const char *fo) {
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd), "%s %s %s %s > /dev/null", tool_path, fa, fb, fo);
-    int rc = system(cmd);
-    return (rc == 0);
+extern char **environ;
+
+static const char *tool_path = "./statdump_tool";
+
+// Runs statdump_tool with argv[1..] (NULL-terminated), stdout discarded;
+// returns its exit code or -1 if it could not be run
+static int run_tool(char *const args[]) {
+    posix_spawn_file_actions_t fa;
+    if (posix_spawn_file_actions_init(&fa) != 0) return -1;
+    posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0);
+
+    char *argv[16] = { (char*)tool_path };
+    for (int i = 0; args[i] && i < 14; i++) argv[i + 1] = args[i];
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, tool_path, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) return -1;
+
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
 }
 
-int run_tool_with_args(const char *tool, char *args[], int argc) {
-    char cmd[1024] = {0};
-    snprintf(cmd, sizeof(cmd), "%s", tool);
-    for (int i = 0; i < argc; i++) {
-        snprintf(cmd + strlen(cmd), sizeof(cmd) - strlen(cmd), " %s", args[i]);
+// Same steps as statdump_tool, minus the table printout
+static int run_pipeline(const char *fa, const char *fb, const char *fo) {
+    StatData *a = NULL, *b = NULL, *j = NULL;
+    size_t na = 0, nb = 0, nj = 0;
+
+    int ok = (LoadDump(fa, &a, &na) == SD_OK &&
+              LoadDump(fb, &b, &nb) == SD_OK &&
+              JoinDump(a, na, b, nb, &j, &nj) == SD_OK);
+    free(a); free(b);
+
+    if (ok) {
+        SortDump(j, nj);
+        ok = (StoreDump(fo, j, nj) == SD_OK);
     }
-    strncat(cmd, " > /dev/null", sizeof(cmd) - strlen(cmd) - 1);
-    int rc = system(cmd);
-    return (rc == 0);
+    free(j);
+    return ok;
+}
+
+static int cmp_long(const void *pa, const void *pb) {
+    long x = *(const long*)pa, y = *(const long*)pb;
+    return (x > y) - (x < y);
+}
+
+static int cmp_float(const void *pa, const void *pb) {
+    float x = *(const float*)pa, y = *(const float*)pb;
+    return (x > y) - (x < y);
 }
 
+static int cmp_id(const void *pa, const void *pb) {
+    const StatData *x = (const StatData*)pa;
+    const StatData *y = (const StatData*)pb;
+    if (x->id < y->id) return -1;
+    if (x->id > y->id) return 1;
+    return 0;
+}
 
 static int load_and_check_exact(const char *fo, const StatData *exp, size_t nexp) {
     StatData *out = NULL; size_t nout = 0;
@@ -63,11 +110,29 @@ static int is_sorted_by_cost(const StatData *arr, size_t n) {
     return 1;
 }
 
+// Same estimates and exact counters from two summaries
+static int summary_same(const SdSummary *x, const SdSummary *y) {
+    static const double qs[] = { 0.0, 0.01, 0.25, 0.5, 0.9, 0.99, 1.0 };
+    if (SummaryDistinctIds(x) != SummaryDistinctIds(y)) return 0;
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+        if (SummaryCostQuantile(x, qs[i]) != SummaryCostQuantile(y, qs[i])) return 0;
+    }
+
+    SdSummaryTotals ax, ay, mx[8], my[8];
+    SummaryTotals(x, &ax, mx, NULL);
+    SummaryTotals(y, &ay, my, NULL);
+    if (ax.records != ay.records || ax.count != ay.count) return 0;
+    for (int m = 0; m < 8; m++) {
+        if (mx[m].records != my[m].records || mx[m].count != my[m].count) return 0;
+    }
+    return 1;
+}
+
 // -------------------- test cases -------------------- 
 
 typedef struct {
     const char *name;
-    int (*fn)(const char *tool_path);
+    int (*fn)(void);
 } TestCase;
 
 // Case 1 from task
@@ -84,7 +149,7 @@ static const StatData case_1_out[3] =
  {.id = 90889, .count = 13,   .cost = 3.567f,   .primary = 0, .mode = 3 },
  {.id = 90089, .count = 14,   .cost = 88.911f,  .primary = 0, .mode = 2 }};
 
-static int test_case_1(const char *tool) {
+static int test_case_1(void) {
     const char *fa = "t_case1_a.bin";
     const char *fb = "t_case1_b.bin";
     const char *fo = "t_case1_out.bin";
@@ -92,12 +157,12 @@ static int test_case_1(const char *tool) {
     if (StoreDump(fa, case_1_in_a, 2) != SD_OK) return 0;
     if (StoreDump(fb, case_1_in_b, 2) != SD_OK) return 0;
 
-    if (!run_tool(tool, fa, fb, fo)) return 0;
+    if (!run_pipeline(fa, fb, fo)) return 0;
     return load_and_check_exact(fo, case_1_out, 3);
 }
 
 // Case 2: both empty arrays -> empty output
-static int test_empty_empty(const char *tool) {
+static int test_empty_empty(void) {
     const char *fa = "t_empty_a.bin";
     const char *fb = "t_empty_b.bin";
     const char *fo = "t_empty_out.bin";
@@ -105,7 +170,7 @@ static int test_empty_empty(const char *tool) {
     if (StoreDump(fa, NULL, 0) != SD_OK) return 0;
     if (StoreDump(fb, NULL, 0) != SD_OK) return 0;
 
-    if (!run_tool(tool, fa, fb, fo)) return 0;
+    if (!run_pipeline(fa, fb, fo)) return 0;
 
     StatData *out = NULL; size_t nout = 0;
     if (LoadDump(fo, &out, &nout) != SD_OK) return 0;
@@ -126,7 +191,7 @@ static const StatData case_3_out[4] =
  {.id=2, .count=1, .cost=5.0f, .primary=0, .mode=7},
  {.id=3, .count=1, .cost=9.0f, .primary=1, .mode=1}};
 
-static int test_one_empty(const char *tool) {
+static int test_one_empty(void) {
     const char *fa = "t_oneempty_a.bin";
     const char *fb = "t_oneempty_b.bin";
     const char *fo = "t_oneempty_out.bin";
@@ -134,7 +199,7 @@ static int test_one_empty(const char *tool) {
     if (StoreDump(fa, NULL, 0) != SD_OK) return 0;
     if (StoreDump(fb, case_3_in_b, 4) != SD_OK) return 0;
 
-    if (!run_tool(tool, fa, fb, fo)) return 0;
+    if (!run_pipeline(fa, fb, fo)) return 0;
     return load_and_check_exact(fo, case_3_out, 4);
 }
 
@@ -170,7 +235,7 @@ static const StatData case_4_out[4] =
  {.id=10, .count=10, .cost=10.0f, .primary=0, .mode=3},
 };
 
-static int test_dups_within_and_across(const char *tool) {
+static int test_dups_within_and_across(void) {
     const char *fa = "t_dups_a.bin";
     const char *fb = "t_dups_b.bin";
     const char *fo = "t_dups_out.bin";
@@ -178,7 +243,7 @@ static int test_dups_within_and_across(const char *tool) {
     if (StoreDump(fa, case_4_in_a, 5) != SD_OK) return 0;
     if (StoreDump(fb, case_4_in_b, 3) != SD_OK) return 0;
 
-    if (!run_tool(tool, fa, fb, fo)) return 0;
+    if (!run_pipeline(fa, fb, fo)) return 0;
     return load_and_check_exact(fo, case_4_out, 4);
 }
 
@@ -198,7 +263,7 @@ static const StatData case_5_out[1] =
  {.id=7, .count=3, .cost=3.0f, .primary=0, .mode=6},
 };
 
-static int test_primary_mode_rules(const char *tool) {
+static int test_primary_mode_rules(void) {
     const char *fa = "t_rules_a.bin";
     const char *fb = "t_rules_b.bin";
     const char *fo = "t_rules_out.bin";
@@ -206,12 +271,12 @@ static int test_primary_mode_rules(const char *tool) {
     if (StoreDump(fa, case_5_in_a, 2) != SD_OK) return 0;
     if (StoreDump(fb, case_5_in_b, 1) != SD_OK) return 0;
 
-    if (!run_tool(tool, fa, fb, fo)) return 0;
+    if (!run_pipeline(fa, fb, fo)) return 0;
     return load_and_check_exact(fo, case_5_out, 1);
 }
 
 // Case 6: large randomized
-static int test_large_random_sanity(const char *tool) {
+static int test_large_random_sanity(void) {
     const char *fa = "t_large_a.bin";
     const char *fb = "t_large_b.bin";
     const char *fo = "t_large_out.bin";
@@ -244,7 +309,7 @@ static int test_large_random_sanity(const char *tool) {
 
     free(a); free(b);
 
-    if (ok && !run_tool(tool, fa, fb, fo)) ok = 0;
+    if (ok && !run_pipeline(fa, fb, fo)) ok = 0;
 
     StatData *out = NULL; size_t nout = 0;
     if (ok && LoadDump(fo, &out, &nout) != SD_OK) ok = 0;
@@ -262,14 +327,7 @@ static int test_large_random_sanity(const char *tool) {
         if (nout && !cpy) ok = 0;
         if (ok && nout) {
             memcpy(cpy, out, nout * sizeof(StatData));
-            
-            int cmp_id(const void *pa, const void *pb) {
-                const StatData *x = (const StatData*)pa;
-                const StatData *y = (const StatData*)pb;
-                if (x->id < y->id) return -1;
-                if (x->id > y->id) return 1;
-                return 0;
-            }
+
             qsort(cpy, nout, sizeof(StatData), cmp_id);
             for (size_t i = 1; i < nout; i++) {
                 if (cpy[i].id == cpy[i-1].id) { ok = 0; break; }
@@ -282,19 +340,58 @@ static int test_large_random_sanity(const char *tool) {
     return ok;
 }
 
-// Case 7: wrong args number
-static int test_invalid_arguments(const char *tool) {
-    char *invalid_args[] = {"statdump_tool", "input_a.bin"};
-    int result = run_tool_with_args(tool, invalid_args, 2);
+// Case 7: invalid arguments are rejected, not dereferenced
+static int test_invalid_arguments(void) {
+    StatData *out = NULL;
+    size_t nout = 0;
+    StatData got;
+    const StatData one = {.id = 1, .count = 1, .cost = 1.0f, .primary = 1, .mode = 1};
+
+    return (LoadDump(NULL, &out, &nout) == SD_ERR_INVAL &&
+            LoadDump("t_inval.bin", NULL, &nout) == SD_ERR_INVAL &&
+            StoreDump(NULL, &one, 1) == SD_ERR_INVAL &&
+            StoreDump("t_inval.bin", NULL, 1) == SD_ERR_INVAL &&
+            JoinDump(NULL, 1, &one, 1, &out, &nout) == SD_ERR_INVAL &&
+            JoinDump(&one, 1, &one, 1, NULL, &nout) == SD_ERR_INVAL &&
+            BuildDumpIndex(NULL, "t_inval.idx") == SD_ERR_INVAL &&
+            LookupDumpId(NULL, 1, &got) == SD_ERR_INVAL);
+}
 
-    if (result == 0) {
-        printf("Error: Incorrect number of arguments.\n");
-    }
-    return (result == 0);
+// Case 7b: the tool itself rejects a bad argc and joins in-process fixtures
+static int test_tool_cli(void) {
+    char *bad[] = { "input_a.bin", NULL };
+    if (run_tool(bad) != 2) return 0;
+
+    if (StoreDump("t_cli_a.bin", case_1_in_a, 2) != SD_OK) return 0;
+    if (StoreDump("t_cli_b.bin", case_1_in_b, 2) != SD_OK) return 0;
+
+    char *join[] = { "t_cli_a.bin", "t_cli_b.bin", "t_cli_out.bin", NULL };
+    if (run_tool(join) != 0) return 0;
+    return load_and_check_exact("t_cli_out.bin", case_1_out, 3);
+}
+
+// Case 7c: --summary accepts dumps (empty ones too) and merges stored summaries
+static int test_tool_summary_cli(void) {
+    if (StoreDump("t_cli_a.bin", case_4_in_a, 5) != SD_OK) return 0;
+    if (StoreDump("t_cli_b.bin", case_4_in_b, 3) != SD_OK) return 0;
+    if (StoreDump("t_cli_empty.bin", NULL, 0) != SD_OK) return 0;
+
+    char *one[] = { "--summary", "t_cli_a.sum", "t_cli_a.bin", "t_cli_empty.bin", NULL };
+    char *two[] = { "--summary", "t_cli_ab.sum", "t_cli_a.sum", "t_cli_b.bin", NULL };
+    if (run_tool(one) != 0 || run_tool(two) != 0) return 0;
+
+    SdSummary *got = NULL, *exp = NULL;
+    int ok = (SummaryLoad("t_cli_ab.sum", &got) == SD_OK &&
+              SummaryCreate(&exp) == SD_OK &&
+              SummaryAdd(exp, case_4_in_a, 5) == SD_OK &&
+              SummaryAdd(exp, case_4_in_b, 3) == SD_OK &&
+              summary_same(got, exp));
+    SummaryFree(got); SummaryFree(exp);
+    return ok;
 }
 
 // Case 8: read & write non existing file
-static int test_file_read_error(const char *tool) {
+static int test_file_read_error(void) {
     const char *invalid_file = "invalid_file.bin";
 
     StatData *out = NULL;
@@ -308,7 +405,7 @@ static int test_file_read_error(const char *tool) {
 }
 
 // Case 9: read no header file
-static int test_corrupted_file(const char *tool) {
+static int test_corrupted_file(void) {
     const char *corrupted_file = "corrupted_file.bin";
 
     StatData corrupted_data = {.id = 1, .count = 1, .cost = 1.0f, .primary = 1, .mode = 1};
@@ -354,7 +451,7 @@ static const StatData case_11_out[11] =
  {.id=10, .count=10, .cost=16.0f, .primary=1, .mode=3},
  {.id=11, .count=11, .cost=17.0f, .primary=1, .mode=4}};
 
-static int test_eleven_records(const char *tool) {
+static int test_eleven_records(void) {
     const char *fa = "t_ele_a.bin";
     const char *fb = "t_ele_b.bin";
     const char *fo = "t_ele_out.bin";
@@ -362,23 +459,693 @@ static int test_eleven_records(const char *tool) {
     if (StoreDump(fa, NULL, 0) != SD_OK) return 0;
     if (StoreDump(fb, case_11_in_b, 11) != SD_OK) return 0;
 
-    if (!run_tool(tool, fa, fb, fo)) return 0;
+    if (!run_pipeline(fa, fb, fo)) return 0;
     return load_and_check_exact(fo, case_11_out, 11);
 }
 
+// Case 11: point lookups over an id-sorted dump, single and batched
+static int test_lookup_index(void) {
+    const char *fd = "t_lookup.bin";
+    const char *fi = "t_lookup.idx";
+
+    // spans several index blocks with a short tail block
+    const size_t n = 1000;
+    StatData *arr = (StatData*)calloc(n, sizeof(StatData));
+    if (!arr) return 0;
+    for (size_t i = 0; i < n; i++) {
+        arr[i].id = (long)(i * 3 + 1); // gaps between ids are misses
+        arr[i].count = (int)(rand() % 100u);
+        arr[i].cost = (float)rand() / (float)RAND_MAX * 1000.0f;
+        arr[i].primary = (unsigned)(rand() & 1u);
+        arr[i].mode = (unsigned)(rand() & 7u);
+    }
+
+    int ok = (StoreDump(fd, arr, n) == SD_OK &&
+              BuildDumpIndex(fd, fi) == SD_OK);
+
+    SdDumpIndex *ix = NULL;
+    if (ok && OpenDumpIndex(fd, fi, &ix) != SD_OK) ok = 0;
+
+    for (long id = -2; ok && id <= (long)(n * 3 + 2); id++) {
+        StatData got;
+        SdStatus st = LookupDumpId(ix, id, &got);
+        if (id >= 1 && id <= (long)(n * 3 - 2) && (id - 1) % 3 == 0) {
+            ok = (st == SD_OK && stat_eq(&got, &arr[(id - 1) / 3]));
+        } else {
+            ok = (st == SD_ERR_NOTFOUND);
+        }
+    }
+
+    const size_t nq = 777;
+    long *ids = (long*)malloc(nq * sizeof(long));
+    StatData *out = (StatData*)malloc(nq * sizeof(StatData));
+    unsigned char *found = (unsigned char*)malloc(nq);
+    if (!ids || !out || !found) ok = 0;
+
+    if (ok) {
+        for (size_t i = 0; i < nq; i++) ids[i] = (long)(rand() % (n * 3 + 4u)) - 1;
+        if (LookupDump(ix, ids, nq, out, found) != SD_OK) ok = 0;
+        for (size_t i = 0; ok && i < nq; i++) {
+            long id = ids[i];
+            if (id >= 1 && id <= (long)(n * 3 - 2) && (id - 1) % 3 == 0) {
+                ok = (found[i] && stat_eq(&out[i], &arr[(id - 1) / 3]));
+            } else {
+                ok = !found[i];
+            }
+        }
+    }
+
+    CloseDumpIndex(ix);
+    free(ids); free(out); free(found);
+
+    // a stale sidecar is rejected even when the record count still matches
+    if (ok) {
+        for (size_t i = 0; i < n; i++) arr[i].id += 1;
+        ok = (StoreDump(fd, arr, n) == SD_OK &&
+              OpenDumpIndex(fd, fi, &ix) == SD_ERR_FMT && ix == NULL);
+        for (size_t i = 0; i < n; i++) arr[i].id -= 1;
+    }
+
+    // cost-sorted (tool output) dumps cannot be indexed
+    if (ok) {
+        StatData tmp = arr[0]; arr[0] = arr[1]; arr[1] = tmp;
+        ok = (StoreDump(fd, arr, n) == SD_OK &&
+              BuildDumpIndex(fd, fi) == SD_ERR_FMT);
+    }
+
+    free(arr);
+    return ok;
+}
+
+// -------------------- reference implementations -------------------- 
+// Deliberately naive: quadratic join in input order, stable merge sort,
+// linear lookup. Optimized paths must agree with these.
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+    uint64_t x = rng_state;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return rng_state = x;
+}
+
+static size_t ref_join(const StatData *a, size_t na, const StatData *b, size_t nb,
+                       StatData *out, unsigned *terms) {
+    size_t w = 0;
+    for (size_t i = 0; i < na + nb; i++) {
+        const StatData *x = (i < na) ? &a[i] : &b[i - na];
+        size_t k = 0;
+        while (k < w && out[k].id != x->id) k++;
+        if (k == w) { out[w] = *x; terms[w] = 1; w++; continue; }
+        out[k].count += x->count;
+        out[k].cost += x->cost;
+        out[k].primary = (unsigned)(out[k].primary && x->primary);
+        if (x->mode > out[k].mode) out[k].mode = x->mode;
+        terms[k]++;
+    }
+    return w;
+}
+
+static void ref_merge_sort(StatData *arr, StatData *tmp, size_t n,
+                           int (*cmp)(const void*, const void*)) {
+    if (n < 2) return;
+    size_t h = n / 2;
+    ref_merge_sort(arr, tmp, h, cmp);
+    ref_merge_sort(arr + h, tmp, n - h, cmp);
+    size_t i = 0, j = h, k = 0;
+    while (i < h && j < n) tmp[k++] = (cmp(&arr[j], &arr[i]) < 0) ? arr[j++] : arr[i++];
+    while (i < h) tmp[k++] = arr[i++];
+    while (j < n) tmp[k++] = arr[j++];
+    memcpy(arr, tmp, n * sizeof(StatData));
+}
+
+static int cmp_cost_ref(const void *pa, const void *pb) {
+    const StatData *x = (const StatData*)pa;
+    const StatData *y = (const StatData*)pb;
+    if (x->cost < y->cost) return -1;
+    if (x->cost > y->cost) return 1;
+    return 0;
+}
+
+// Total order on every field, so equal multisets sort identically
+static int cmp_all_ref(const void *pa, const void *pb) {
+    const StatData *x = (const StatData*)pa;
+    const StatData *y = (const StatData*)pb;
+    int c = cmp_id(pa, pb);
+    if (c) return c;
+    c = cmp_cost_ref(pa, pb);
+    if (c) return c;
+    if (x->count != y->count) return (x->count < y->count) ? -1 : 1;
+    if (x->primary != y->primary) return (x->primary < y->primary) ? -1 : 1;
+    if (x->mode != y->mode) return (x->mode < y->mode) ? -1 : 1;
+    return 0;
+}
+
+// -------------------- differential checks -------------------- 
+
+typedef enum {
+    GEN_RANDOM,       // moderate collisions
+    GEN_ALL_SAME_ID,  // everything folds into one row
+    GEN_ALL_UNIQUE,   // nothing folds
+    GEN_EXTREME_IDS,  // LONG_MIN / LONG_MAX / 0 / -1
+    GEN_SORTED,       // ascending id and cost
+    GEN_REVERSED,     // descending id and cost
+    GEN_EQUAL_COST,   // sort sees only ties
+    GEN_SIGNED_COST,  // negative costs and signed zeros
+    GEN_COUNT
+} GenKind;
+
+static const char *gen_name[GEN_COUNT] = {
+    "random", "all_same_id", "all_unique", "extreme_ids",
+    "sorted", "reversed", "equal_cost", "signed_cost"
+};
+
+static void gen_fill(StatData *arr, size_t n, GenKind kind, size_t salt) {
+    static const long extremes[] = { LONG_MIN, LONG_MIN + 1, -1, 0, 1, LONG_MAX - 1, LONG_MAX };
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = rng_next();
+        StatData *x = &arr[i];
+        x->count = (int)(r % 1000u);
+        x->cost = (float)((r >> 10) % 100000u) / 100.0f;
+        x->primary = (unsigned)((r >> 40) & 1u);
+        x->mode = (unsigned)((r >> 41) & 7u);
+
+        switch (kind) {
+            case GEN_RANDOM: x->id = (long)((r >> 20) % (n / 2 + 1)); break;
+            case GEN_ALL_SAME_ID: x->id = 42; break;
+            case GEN_ALL_UNIQUE: x->id = (long)(salt * n + i); break;
+            case GEN_EXTREME_IDS: x->id = extremes[(r >> 20) % 7u]; break;
+            case GEN_SORTED:
+                x->id = (long)(salt * n + i);
+                x->cost = (float)i;
+                break;
+            case GEN_REVERSED:
+                x->id = (long)(n - i) - (long)(salt * n);
+                x->cost = (float)(n - i);
+                break;
+            case GEN_EQUAL_COST:
+                x->id = (long)((r >> 20) % (n + 1));
+                x->cost = 1.0f;
+                break;
+            case GEN_SIGNED_COST:
+                x->id = (long)((r >> 20) % (n / 4 + 1));
+                x->cost = ((r >> 50) & 1u) ? -x->cost : ((r >> 51) & 1u) ? -0.0f : x->cost;
+                break;
+            default: break;
+        }
+    }
+}
+
+// Join: same rows as the reference. Fold order differs, so cost gets a
+// rounding allowance proportional to the number of folded terms.
+static int check_join(const StatData *a, size_t na, const StatData *b, size_t nb,
+                      StatData **out_j, size_t *out_nj) {
+    StatData *ref = (StatData*)malloc((na + nb + 1) * sizeof(StatData));
+    unsigned *terms = (unsigned*)malloc((na + nb + 1) * sizeof(unsigned));
+    StatData *j = NULL; size_t nj = 0;
+    int ok = (ref && terms && JoinDump(a, na, b, nb, &j, &nj) == SD_OK);
+
+    size_t nr = ok ? ref_join(a, na, b, nb, ref, terms) : 0;
+    if (ok && nj != nr) ok = 0;
+
+    // JoinDump output is id-ascending with unique ids
+    for (size_t i = 1; ok && i < nj; i++) {
+        if (j[i-1].id >= j[i].id) ok = 0;
+    }
+
+    for (size_t k = 0; ok && k < nr; k++) {
+        const StatData *g = (const StatData*)bsearch(&ref[k], j, nj, sizeof(StatData), cmp_id);
+        ok = (g && g->count == ref[k].count &&
+              g->primary == ref[k].primary && g->mode == ref[k].mode &&
+              float_eq_rel(g->cost, ref[k].cost, 1e-6f * (float)(terms[k] + 1)));
+    }
+
+    free(ref); free(terms);
+    if (ok && out_j) { *out_j = j; *out_nj = nj; }
+    else free(j);
+    return ok;
+}
+
+// Sort: a permutation of the input, in the same cost sequence as a stable sort
+static int check_sort(const StatData *in, size_t n) {
+    StatData *got = (StatData*)malloc((n + 1) * sizeof(StatData));
+    StatData *ref = (StatData*)malloc((n + 1) * sizeof(StatData));
+    StatData *tmp = (StatData*)malloc((n + 1) * sizeof(StatData));
+    int ok = (got && ref && tmp);
+
+    if (ok && n) {
+        memcpy(got, in, n * sizeof(StatData));
+        memcpy(ref, in, n * sizeof(StatData));
+        SortDump(got, n);
+        ref_merge_sort(ref, tmp, n, cmp_cost_ref);
+
+        for (size_t i = 0; ok && i < n; i++) {
+            if (cmp_cost_ref(&got[i], &ref[i]) != 0) ok = 0;
+        }
+        ref_merge_sort(got, tmp, n, cmp_all_ref);
+        ref_merge_sort(ref, tmp, n, cmp_all_ref);
+        for (size_t i = 0; ok && i < n; i++) {
+            if (cmp_all_ref(&got[i], &ref[i]) != 0) ok = 0;
+        }
+    }
+
+    free(got); free(ref); free(tmp);
+    return ok;
+}
+
+// Neighbour of id, staying put at the ends of the range instead of overflowing
+static long near_miss(long id, int up) {
+    if (up) return (id == LONG_MAX) ? id : id + 1;
+    return (id == LONG_MIN) ? id : id - 1;
+}
+
+// Store/Load round-trip and indexed lookups against a linear scan
+static int check_io_lookup(const StatData *j, size_t nj) {
+    const char *fd = "t_diff.bin";
+    const char *fi = "t_diff.idx";
+
+    StatData *back = NULL; size_t nback = 0;
+    int ok = (StoreDump(fd, j, nj) == SD_OK &&
+              LoadDump(fd, &back, &nback) == SD_OK &&
+              nback == nj);
+    for (size_t i = 0; ok && i < nj; i++) {
+        ok = (memcmp(&back[i].id, &j[i].id, sizeof(long)) == 0 && stat_eq(&back[i], &j[i]));
+    }
+    free(back);
+
+    SdDumpIndex *ix = NULL;
+    if (ok) ok = (BuildDumpIndex(fd, fi) == SD_OK && OpenDumpIndex(fd, fi, &ix) == SD_OK);
+
+    const size_t nq = 2 * nj + 8;
+    long *ids = (long*)malloc(nq * sizeof(long));
+    StatData *out = (StatData*)malloc(nq * sizeof(StatData));
+    unsigned char *found = (unsigned char*)malloc(nq);
+    if (!ids || !out || !found) ok = 0;
+
+    if (ok) {
+        // half hits, half near-misses and extremes
+        for (size_t q = 0; q < nq; q++) {
+            uint64_t r = rng_next();
+            if (nj && (r & 1u)) ids[q] = j[(r >> 1) % nj].id;
+            else if (nj && (r & 2u)) ids[q] = near_miss(j[(r >> 2) % nj].id, (r >> 8) & 1u);
+            else ids[q] = (r & 4u) ? LONG_MIN : LONG_MAX;
+        }
+        ok = (LookupDump(ix, ids, nq, out, found) == SD_OK);
+    }
+
+    for (size_t q = 0; ok && q < nq; q++) {
+        size_t k = 0;
+        while (k < nj && j[k].id != ids[q]) k++;
+
+        StatData one;
+        SdStatus st = LookupDumpId(ix, ids[q], &one);
+        if (k == nj) {
+            ok = (!found[q] && st == SD_ERR_NOTFOUND);
+        } else {
+            ok = (found[q] && st == SD_OK && stat_eq(&out[q], &j[k]) && stat_eq(&one, &j[k]));
+        }
+    }
+
+    CloseDumpIndex(ix);
+    free(ids); free(out); free(found);
+    return ok;
+}
+
+// Case 12: every generator x several sizes, including empty sides
+static int test_differential(void) {
+    static const size_t sizes[] = { 0, 1, 2, 7, 64, 129, 700, 3000 };
+    const size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+    int ok = 1;
+
+    for (int kind = 0; kind < GEN_COUNT; kind++) {
+        for (size_t si = 0; si < nsizes; si++) {
+            size_t na = sizes[si];
+            size_t nb = sizes[(si * 5 + (size_t)kind) % nsizes];
+            StatData *a = (StatData*)calloc(na + 1, sizeof(StatData));
+            StatData *b = (StatData*)calloc(nb + 1, sizeof(StatData));
+            StatData *j = NULL; size_t nj = 0;
+            if (!a || !b) { free(a); free(b); return 0; }
+
+            gen_fill(a, na, (GenKind)kind, 0);
+            gen_fill(b, nb, (GenKind)kind, 1);
+
+            const char *stage = "join";
+            int st_ok = check_join(a, na, b, nb, &j, &nj);
+            if (st_ok) { stage = "sort"; st_ok = check_sort(a, na) && check_sort(j, nj); }
+            if (st_ok) { stage = "io/lookup"; st_ok = check_io_lookup(j, nj); }
+            if (!st_ok) {
+                fprintf(stderr, "  differential mismatch: %s, gen=%s na=%zu nb=%zu\n",
+                        stage, gen_name[kind], na, nb);
+                ok = 0;
+            }
+
+            free(a); free(b); free(j);
+        }
+    }
+    return ok;
+}
+
+// Case 13: summary sketches against exact statistics; merge and round-trips
+static int test_summary_sketches(void) {
+    const char *fd = "t_summary.bin";
+    const char *fs = "t_summary.sum";
+
+    const size_t n = 100000;
+    StatData *arr = (StatData*)calloc(n, sizeof(StatData));
+    long *ids = (long*)malloc(n * sizeof(long));
+    float *costs = (float*)malloc(n * sizeof(float));
+    if (!arr || !ids || !costs) { free(arr); free(ids); free(costs); return 0; }
+
+    // log-uniform costs over seven decades, some negative, some zero
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = rng_next();
+        arr[i].id = (long)(r % 60000u) * 7919 - 1000000;
+        arr[i].count = (int)((r >> 16) % 100u);
+        arr[i].cost = (float)pow(10.0, (double)((r >> 24) % 7000u) / 1000.0 - 3.0);
+        if ((r >> 40) % 10u == 0) arr[i].cost = -arr[i].cost;
+        if ((r >> 44) % 50u == 0) arr[i].cost = 0.0f;
+        arr[i].primary = (unsigned)((r >> 50) & 1u);
+        arr[i].mode = (unsigned)((r >> 51) & 7u);
+        ids[i] = arr[i].id;
+        costs[i] = arr[i].cost;
+    }
+
+    SdSummary *all = NULL, *lo = NULL, *hi = NULL, *disk = NULL, *back = NULL;
+    int ok = (SummaryCreate(&all) == SD_OK && SummaryCreate(&lo) == SD_OK &&
+              SummaryCreate(&hi) == SD_OK && SummaryCreate(&disk) == SD_OK &&
+              SummaryAdd(all, arr, n) == SD_OK);
+
+    // distinct ids within 5%
+    if (ok) {
+        qsort(ids, n, sizeof(long), cmp_long);
+        size_t distinct = (n != 0);
+        for (size_t i = 1; i < n; i++) distinct += (ids[i] != ids[i-1]);
+        double est = SummaryDistinctIds(all);
+        ok = (fabs(est - (double)distinct) <= 0.05 * (double)distinct);
+    }
+
+    // quantiles within the sketch's relative accuracy
+    if (ok) {
+        static const double qs[] = { 0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 1.0 };
+        qsort(costs, n, sizeof(float), cmp_float);
+        for (size_t i = 0; ok && i < sizeof(qs) / sizeof(qs[0]); i++) {
+            float exact = costs[(size_t)(qs[i] * (double)(n - 1))];
+            float est = SummaryCostQuantile(all, qs[i]);
+            ok = (fabsf(est - exact) <= 0.011f * fabsf(exact));
+        }
+    }
+
+    // exact per-mode / per-primary totals
+    if (ok) {
+        SdSummaryTotals tot, by_mode[8], by_primary[2];
+        SdSummaryTotals exp_mode[8] = {{0}}, exp_primary[2] = {{0}};
+        for (size_t i = 0; i < n; i++) {
+            exp_mode[arr[i].mode].records++;
+            exp_mode[arr[i].mode].count += arr[i].count;
+            exp_primary[arr[i].primary].records++;
+            exp_primary[arr[i].primary].count += arr[i].count;
+        }
+        SummaryTotals(all, &tot, by_mode, by_primary);
+        ok = (tot.records == n);
+        for (int m = 0; ok && m < 8; m++) {
+            ok = (by_mode[m].records == exp_mode[m].records && by_mode[m].count == exp_mode[m].count);
+        }
+        for (int p = 0; ok && p < 2; p++) {
+            ok = (by_primary[p].records == exp_primary[p].records &&
+                  by_primary[p].count == exp_primary[p].count);
+        }
+    }
+
+    // per-shard summaries merge into the single-pass result
+    if (ok) {
+        ok = (SummaryAdd(lo, arr, n / 3) == SD_OK &&
+              SummaryAdd(hi, arr + n / 3, n - n / 3) == SD_OK &&
+              SummaryMerge(lo, hi) == SD_OK &&
+              summary_same(lo, all));
+    }
+
+    // streaming a dump and reloading a stored summary change nothing
+    if (ok) {
+        ok = (StoreDump(fd, arr, n) == SD_OK &&
+              SummaryAddDump(disk, fd) == SD_OK &&
+              summary_same(disk, all) &&
+              SummaryStore(fs, all) == SD_OK &&
+              SummaryLoad(fs, &back) == SD_OK &&
+              summary_same(back, all));
+    }
+
+    // a dump is not a summary, not even one shorter than a summary header
+    if (ok) {
+        SdSummary *bad = NULL, *empty = NULL;
+        ok = (SummaryLoad(fd, &bad) == SD_ERR_FMT && bad == NULL &&
+              StoreDump(fd, NULL, 0) == SD_OK &&
+              SummaryLoad(fd, &bad) == SD_ERR_FMT && bad == NULL &&
+              SummaryCreate(&empty) == SD_OK &&
+              SummaryAddDump(empty, fd) == SD_OK &&
+              SummaryDistinctIds(empty) == 0.0 &&
+              isnan(SummaryCostQuantile(empty, 0.5)));
+        SummaryFree(empty);
+    }
+
+    // infinite costs land at the ends of the quantile range
+    if (ok) {
+        const StatData inf[4] = {
+            {.id = 1, .cost = 1.0f}, {.id = 2, .cost = INFINITY},
+            {.id = 3, .cost = -INFINITY}, {.id = 4, .cost = 2.0f},
+        };
+        SdSummary *x = NULL;
+        ok = (SummaryCreate(&x) == SD_OK && SummaryAdd(x, inf, 4) == SD_OK &&
+              SummaryCostQuantile(x, 0.0) == -INFINITY &&
+              SummaryCostQuantile(x, 1.0) == INFINITY &&
+              isnan(SummaryCostQuantile(x, NAN)) &&
+              SummaryMerge(x, x) == SD_ERR_INVAL &&
+              fabsf(SummaryCostQuantile(x, 0.34f) - 1.0f) <= 0.011f);
+        SummaryFree(x);
+    }
+
+    // corrupt files: a window offset outside the key range, trailing bytes
+    if (ok) {
+        SdSummary *bad = NULL;
+        const int32_t far = INT32_MAX - 10;
+        FILE *f = fopen(fs, "r+b");
+        // pos.offset follows the header and the HLL registers
+        ok = (f && fseek(f, 24 + 4096, SEEK_SET) == 0 && fwrite(&far, sizeof(far), 1, f) == 1);
+        if (f) fclose(f);
+        ok = ok && (SummaryLoad(fs, &bad) == SD_ERR_FMT && bad == NULL);
+
+        ok = ok && (SummaryStore(fs, all) == SD_OK);
+        f = ok ? fopen(fs, "ab") : NULL;
+        ok = ok && f && fputc(0, f) != EOF;
+        if (f) fclose(f);
+        ok = ok && (SummaryLoad(fs, &bad) == SD_ERR_FMT && bad == NULL);
+    }
+
+    SummaryFree(all); SummaryFree(lo); SummaryFree(hi); SummaryFree(disk); SummaryFree(back);
+    free(arr); free(ids); free(costs);
+    return ok;
+}
+
+// -------------------- performance baseline -------------------- 
+// Each stage reports the best of PERF_REPS runs in ns per record. The
+// baseline file holds "<stage> <ns_per_record> <tolerance>" lines; a
+// stage fails when it is slower than baseline * (1 + tolerance).
+
+#define PERF_N 200000
+#define PERF_REPS 5
+#define PERF_DEFAULT_TOL 1.0
+
+typedef enum { ST_STORE, ST_LOAD, ST_JOIN, ST_SORT, ST_LOOKUP, ST_SUMMARY, ST_COUNT } PerfStage;
+
+static const char *stage_name[ST_COUNT] = { "store", "load", "join", "sort", "lookup", "summary" };
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int perf_measure(double ns_per_rec[ST_COUNT]) {
+    const char *fa = "t_perf_a.bin";
+    const char *fd = "t_perf_join.bin";
+    const char *fi = "t_perf_join.idx";
+
+    uint64_t saved = rng_state;
+    rng_state = 0x2545F4914F6CDD1Dull; // fixed data set, independent of --seed
+
+    StatData *a = (StatData*)malloc(PERF_N * sizeof(StatData));
+    StatData *b = (StatData*)malloc(PERF_N * sizeof(StatData));
+    StatData *s = (StatData*)malloc(PERF_N * 2 * sizeof(StatData));
+    long *ids = (long*)malloc(PERF_N * sizeof(long));
+    StatData *out = (StatData*)malloc(PERF_N * sizeof(StatData));
+    unsigned char *found = (unsigned char*)malloc(PERF_N);
+    StatData *j = NULL; size_t nj = 0;
+    SdDumpIndex *ix = NULL;
+    int ok = (a && b && s && ids && out && found);
+
+    if (ok) {
+        gen_fill(a, PERF_N, GEN_RANDOM, 0);
+        gen_fill(b, PERF_N, GEN_RANDOM, 1);
+        for (size_t i = 0; i < PERF_N; i++) ids[i] = (long)(rng_next() % PERF_N);
+    }
+    rng_state = saved;
+
+    for (int st = 0; st < ST_COUNT; st++) ns_per_rec[st] = 1e300;
+
+    for (int rep = 0; ok && rep < PERF_REPS; rep++) {
+        double t0 = now_ns();
+        ok = (StoreDump(fa, a, PERF_N) == SD_OK);
+        double t1 = now_ns();
+        StatData *back = NULL; size_t nback = 0;
+        ok = ok && (LoadDump(fa, &back, &nback) == SD_OK);
+        double t2 = now_ns();
+        free(back);
+
+        free(j); j = NULL;
+        ok = ok && (JoinDump(a, PERF_N, b, PERF_N, &j, &nj) == SD_OK);
+        double t3 = now_ns();
+
+        if (ok) memcpy(s, j, nj * sizeof(StatData));
+        double t4 = now_ns();
+        if (ok) SortDump(s, nj);
+        double t5 = now_ns();
+
+        if (ok && !ix) {
+            ok = (StoreDump(fd, j, nj) == SD_OK &&
+                  BuildDumpIndex(fd, fi) == SD_OK &&
+                  OpenDumpIndex(fd, fi, &ix) == SD_OK);
+        }
+        double t6 = now_ns();
+        ok = ok && (LookupDump(ix, ids, PERF_N, out, found) == SD_OK);
+        double t7 = now_ns();
+
+        SdSummary *sum = NULL;
+        ok = ok && (SummaryCreate(&sum) == SD_OK);
+        double t8 = now_ns();
+        ok = ok && (SummaryAdd(sum, a, PERF_N) == SD_OK && SummaryAdd(sum, b, PERF_N) == SD_OK);
+        double t9 = now_ns();
+        SummaryFree(sum);
+
+        if (!ok || nj == 0) { ok = 0; break; }
+        double cur[ST_COUNT] = {
+            (t1 - t0) / PERF_N, (t2 - t1) / PERF_N, (t3 - t2) / (2.0 * PERF_N),
+            (t5 - t4) / (double)nj, (t7 - t6) / PERF_N, (t9 - t8) / (2.0 * PERF_N)
+        };
+        for (int st = 0; st < ST_COUNT; st++) {
+            if (cur[st] < ns_per_rec[st]) ns_per_rec[st] = cur[st];
+        }
+    }
+
+    CloseDumpIndex(ix);
+    free(a); free(b); free(s); free(ids); free(out); free(found); free(j);
+    return ok;
+}
+
+static int baseline_load(const char *path, double base[ST_COUNT], double tol[ST_COUNT]) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    for (int st = 0; st < ST_COUNT; st++) { base[st] = 0.0; tol[st] = PERF_DEFAULT_TOL; }
+
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        char name[32];
+        double ns = 0.0, t = PERF_DEFAULT_TOL;
+        if (line[0] == '#' || sscanf(line, "%31s %lf %lf", name, &ns, &t) < 2) continue;
+        for (int st = 0; st < ST_COUNT; st++) {
+            if (strcmp(name, stage_name[st]) == 0) { base[st] = ns; tol[st] = t; }
+        }
+    }
+    fclose(f);
+    return 1;
+}
+
+static int baseline_store(const char *path, const double ns[ST_COUNT], const double tol[ST_COUNT]) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+
+    fprintf(f, "# stage  ns_per_record  tolerance (fail when slower than base * (1 + tol))\n");
+    fprintf(f, "# %d records per side, best of %d runs; refresh with test_runner --update-baseline\n",
+            PERF_N, PERF_REPS);
+    fprintf(f, "# tolerances are ~2x the run-to-run spread of each stage and survive a refresh\n");
+    for (int st = 0; st < ST_COUNT; st++) {
+        fprintf(f, "%-8s %10.2f %5.2f\n", stage_name[st], ns[st], tol[st]);
+    }
+    return fclose(f) == 0;
+}
+
+static int run_perf(const char *baseline_path, int update) {
+    double ns[ST_COUNT], base[ST_COUNT], tol[ST_COUNT];
+    if (!perf_measure(ns)) {
+        fprintf(stderr, "perf: measurement failed\n");
+        return 0;
+    }
+
+    int have_base = baseline_path && baseline_load(baseline_path, base, tol);
+    if (!have_base) {
+        for (int st = 0; st < ST_COUNT; st++) { base[st] = 0.0; tol[st] = PERF_DEFAULT_TOL; }
+    }
+
+    int ok = 1;
+    printf("%-8s %12s %12s %12s\n", "stage", "ns/rec", "baseline", "limit");
+    for (int st = 0; st < ST_COUNT; st++) {
+        double limit = base[st] * (1.0 + tol[st]);
+        int slow = (!update && base[st] > 0.0 && ns[st] > limit);
+        printf("%-8s %12.2f %12.2f %12.2f %s\n",
+               stage_name[st], ns[st], base[st], limit, slow ? "[SLOW]" : "");
+        if (slow) ok = 0;
+    }
+
+    if (update) {
+        if (!baseline_path || !baseline_store(baseline_path, ns, tol)) {
+            fprintf(stderr, "perf: cannot write baseline\n");
+            return 0;
+        }
+        printf("Baseline written to %s\n", baseline_path);
+    } else if (!have_base) {
+        printf("No baseline%s%s; timings not compared\n",
+               baseline_path ? " at " : "", baseline_path ? baseline_path : "");
+    }
+    return ok;
+}
+
 // -------------------- runner -------------------- 
 
-static int run_one(int num, const char *tool, const TestCase *tc) {
-    int ok = tc->fn(tool);
-    if (!ok) fprintf(stderr, "%d [FAIL] %s\n", num+1, tc->name);
-    else printf("%d [OK]   %s\n", num+1, tc->name);
+static int run_one(int num, const TestCase *tc) {
+    double t0 = now_ns();
+    int ok = tc->fn();
+    double ms = (now_ns() - t0) / 1e6;
+    if (!ok) fprintf(stderr, "%d [FAIL] %s (%.3f ms)\n", num+1, tc->name, ms);
+    else printf("%d [OK]   %s (%.3f ms)\n", num+1, tc->name, ms);
     return ok;
 }
 
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [--seed N] [--tool PATH] [--baseline FILE] [--update-baseline]\n"
+            "          [--no-perf | --perf-only]\n",
+            prog);
+}
+
 int main(int argc, char **argv) {
-    const char *tool = (argc >= 2) ? argv[1] : "./statdump_tool";
+    unsigned long long seed = (unsigned long long)time(NULL);
+    const char *baseline = NULL;
+    int update = 0, perf = 1, cases = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline = argv[++i];
+        else if (strcmp(argv[i], "--update-baseline") == 0) update = 1;
+        else if (strcmp(argv[i], "--no-perf") == 0) perf = 0;
+        else if (strcmp(argv[i], "--perf-only") == 0) cases = 0;
+        else if (strcmp(argv[i], "--tool") == 0 && i + 1 < argc) tool_path = argv[++i];
+        else { usage(argv[0]); return 2; }
+    }
+
+    printf("Seed: %llu\n", seed);
+    srand((unsigned int)seed);
+    rng_state ^= seed * 0xD1B54A32D192ED03ull;
+    if (rng_state == 0) rng_state = 1;
 
-    srand((unsigned int)time(NULL));
     const TestCase tests[] = {
         {"case_1_spec",test_case_1},
         {"empty_empty",test_empty_empty},
@@ -387,34 +1154,46 @@ int main(int argc, char **argv) {
         {"primary_mode_rules", test_primary_mode_rules},
         {"large_random_sanity", test_large_random_sanity},
         {"invalid_arguments", test_invalid_arguments},
+        {"tool_cli", test_tool_cli},
+        {"tool_summary_cli", test_tool_summary_cli},
         {"file_read_error", test_file_read_error},
         {"corrupted_file", test_corrupted_file},
-        {"eleven_records", test_eleven_records}
+        {"eleven_records", test_eleven_records},
+        {"lookup_index", test_lookup_index},
+        {"differential_vs_reference", test_differential},
+        {"summary_sketches", test_summary_sketches}
     };
 
-    clock_t t0 = clock();
+    double t0 = now_ns();
 
     int all_ok = 1;
     int passed_tests = 0; 
     size_t num_tests = sizeof(tests) / sizeof(tests[0]);
 
-    for (size_t i = 0; i < num_tests; i++) {
-        if (run_one(i, tool, &tests[i])) {
+    for (size_t i = 0; cases && i < num_tests; i++) {
+        if (run_one(i, &tests[i])) {
             passed_tests++;
         } else {
             all_ok = 0;
         }
     }
 
-    clock_t t1 = clock();
-    double ms = 1000.0 * (double)(t1 - t0) / (double)CLOCKS_PER_SEC;
+    double ms = (now_ns() - t0) / 1e6;
+    if (cases) {
+        printf("Tests passed: %d / %zu\n", passed_tests, num_tests);
+        if (all_ok) printf("All tests passed. Time: %.3f ms\n", ms);
+        else fprintf(stderr, "Some tests FAILED. Time: %.3f ms\n", ms);
+    }
 
-    printf("Tests passed: %d / %zu\n", passed_tests, num_tests);
-    if (all_ok) {
-        printf("All tests passed. Time: %.3f ms\n", ms);
-        return 0;
-    } else {
-        fprintf(stderr, "Some tests FAILED. Time: %.3f ms\n", ms);
-        return 1;
+    int perf_ok = 1;
+    if (perf) {
+        printf("\nPerformance:\n");
+        double p0 = now_ns();
+        perf_ok = run_perf(baseline, update);
+        double perf_ms = (now_ns() - p0) / 1e6;
+        if (perf_ok) printf("Performance OK. Time: %.3f ms\n", perf_ms);
+        else fprintf(stderr, "Performance check FAILED. Time: %.3f ms\n", perf_ms);
     }
-}
\ No newline at end of file
+
+    return (all_ok && perf_ok) ? 0 : 1;
+}